@@ -0,0 +1,115 @@
+/**
+ * @file buffer.c
+ * @author Matthew Bolding; Griffin McPherson
+ * @brief Implements the allocation of the shared buffer.
+ * @version 0.1
+ * @date 2022-04-13
+ * 
+ * @copyright Copyright (c) 2022
+ * 
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "buffer.h"
+#include "definitions.h"
+
+/**
+ * @brief Helper function to round a size up to a whole number of huge pages.
+ * 
+ * @param bytes the requested size
+ * @return size_t the size of the mapping
+ */
+static size_t huge_page_round(size_t bytes) {
+    return (bytes + HUGE_PAGE_SIZE - 1) & ~((size_t) HUGE_PAGE_SIZE - 1);
+}
+
+/**
+ * @brief Helper function to allocate a zeroed buffer of the given size.
+ * 
+ * With ALLOC_DEFAULT, the buffer comes from the heap, aligned to a cache line.
+ * With ALLOC_HUGE, the buffer is mapped from the huge page pool. If that pool is
+ * empty, a regular mapping is made and the kernel is asked to back it with
+ * transparent huge pages instead. Either way, every page is touched up front so
+ * no page faults happen while the threads are running.
+ * 
+ * @param bytes the size of the buffer in bytes
+ * @param alloc the allocator, i.e., ALLOC_DEFAULT or ALLOC_HUGE
+ * @return void* the buffer
+ */
+void *allocate_buffer(size_t bytes, int alloc) {
+    void *buffer;
+
+    if(alloc == ALLOC_DEFAULT) {
+        // Start on a cache line, so padded slots really each have their own lines.
+        int error = posix_memalign(&buffer, CACHE_LINE_SIZE, bytes);
+        if(error != 0) {
+            fprintf(stderr, "posix_memalign: %s\n", strerror(error));
+            exit(1);
+        }
+        memset(buffer, 0, bytes);
+        return buffer;
+    }
+
+    size_t size = huge_page_round(bytes);
+
+    buffer = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if(buffer == MAP_FAILED) {
+        // No reserved huge pages, so fall back to transparent huge pages. Those only back
+        // whole, aligned huge pages, so map an extra one and trim the mapping to alignment.
+        char *mapping = mmap(NULL, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(mapping == MAP_FAILED) {
+            perror("mmap");
+            exit(1);
+        }
+
+        char *aligned = (char *) huge_page_round((size_t) mapping);
+        size_t head = aligned - mapping;
+
+        if(head) munmap(mapping, head);
+        if(HUGE_PAGE_SIZE - head) munmap(aligned + size, HUGE_PAGE_SIZE - head);
+        buffer = aligned;
+
+        if(madvise(buffer, size, MADV_HUGEPAGE) != 0) {
+            perror("madvise");
+            fprintf(stderr, "Continuing without transparent huge pages.\n");
+        }
+    }
+
+    // Pre-fault the whole mapping.
+    memset(buffer, 0, size);
+
+    return buffer;
+}
+
+/**
+ * @brief Helper function to release a buffer obtained from allocate_buffer().
+ * 
+ * @param buffer the buffer
+ * @param bytes the size that was passed to allocate_buffer()
+ * @param alloc the allocator that was passed to allocate_buffer()
+ */
+void free_buffer(void *buffer, size_t bytes, int alloc) {
+    if(alloc == ALLOC_DEFAULT) {
+        free(buffer);
+    } else {
+        munmap(buffer, huge_page_round(bytes));
+    }
+}
+
+/**
+ * @brief Helper function to get the distance, in bytes, between consecutive slots of the buffer.
+ * 
+ * @param layout the slot layout, i.e., LAYOUT_PACKED or LAYOUT_PADDED
+ * @param size the size of one item
+ * @return size_t the stride
+ */
+size_t slot_stride(int layout, size_t size) {
+    // Padded slots each get whole cache lines to themselves.
+    if(layout == LAYOUT_PADDED) return (size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+
+    return size;
+}
@@ -0,0 +1,19 @@
+/**
+ * @file buffer.h
+ * @author Matthew Bolding; Griffin McPherson
+ * @brief Contains function prototypes for buffer.c.
+ * @version 0.1
+ * @date 2022-04-13
+ * 
+ * @copyright Copyright (c) 2022
+ * 
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "definitions.h"
+
+void *allocate_buffer(size_t bytes, int alloc);
+void free_buffer(void *buffer, size_t bytes, int alloc);
+size_t slot_stride(int layout, size_t size);
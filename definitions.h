@@ -9,6 +9,8 @@
  * 
  */
 
+#include <stddef.h>
+#include <limits.h>
 #include <pthread.h>
 #include <semaphore.h>
 #include <math.h>
@@ -23,11 +25,42 @@
 #define FNCTNL_PROD_MAX 999999
 #define FAULTY_PROD_MAX 499999
 
+#define CACHE_LINE_SIZE 64
+#define HUGE_PAGE_SIZE  (2 * 1024 * 1024)
+
+#define ALLOC_DEFAULT 0
+#define ALLOC_HUGE    1
+
+#define LAYOUT_PACKED 0
+#define LAYOUT_PADDED 1
+
+// 64 KiB, unless the platform needs more (e.g., PTHREAD_STACK_MIN is 128 KiB on aarch64).
+#define THREAD_STACK_SIZE ((size_t) PTHREAD_STACK_MIN > 64 * 1024 ? (size_t) PTHREAD_STACK_MIN : (size_t) 64 * 1024)
+
+#define LANES       2
+#define LANE_FNCTNL 0
+#define LANE_FAULTY 1
+
+#ifndef ITEM_TYPEDEF
+#define ITEM_TYPEDEF
+
+struct item {
+    int number;
+    struct timespec produced;
+};
+
+#endif
+
+#define QUEUE_ELEM_TYPE struct item
+#include "queue.h"
+
 #ifndef ARGUMENTS_TYPEDEF
 #define ARGUMENTS_TYPEDEF
 
 struct arguments {
     int items, length, producer, faulty, consumer;
+    int alloc, layout;
+    int lane_length[LANES], weight;
     bool debug;
 };
 
@@ -38,12 +71,28 @@ struct arguments {
 
 struct pthread_arg {
     struct arguments *prog_arg;
-    sem_t mutex;
-    sem_t empty;
-    sem_t full;
-    int *buffer;
-    int in;
-    int out;
+    // With a single lane (num_lanes == 1), every producer shares lanes[0].
+    struct bounded_queue lanes[LANES];
+    // Counts the items across all lanes, so consumers can wait on every lane at once.
+    sem_t ready;
+    // Serializes the statistics, since each lane has its own lock.
+    sem_t report;
+    // The functional items consumed in a row by all consumers, guarded by report.
+    int streak;
+    // Holds every thread back until all of them have been created and checked in.
+    sem_t arrived;
+    pthread_barrier_t start;
+};
+
+#endif
+
+#ifndef LANE_STATS_TYPEDEF
+#define LANE_STATS_TYPEDEF
+
+struct lane_stats {
+    int length, occupancy_max;
+    long items, occupancy_total;
+    double latency_total, latency_max;
 };
 
 #endif
@@ -55,8 +104,11 @@ pthread_t *consumer_arr;
 int num_items_per_producer, buffer_size, num_producers, num_faulty;
 int volatile num_consumer, num_full, num_empty, num_nonprimes, total_consumed;
 
+int num_lanes;
+struct lane_stats lane_stats[LANES];
+
 int volatile *tid_functional,      *tid_faulty,      *tid_consumer, 
              *functional_produced, *faulty_produced, *consumed_thread;
 
 struct timespec now_t;
-struct timeval time_start, time_end, time_elapsed;
\ No newline at end of file
+struct timespec time_start, time_released, time_finished, time_end;
\ No newline at end of file
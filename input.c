@@ -12,6 +12,7 @@
 #include <stdlib.h>
 #include <argp.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "definitions.h"
 #include "input.h"
@@ -35,6 +36,13 @@ static struct argp_option options[] = {
     {"consumer", 'c', "NUM", 0,                   "The number of consumer threads"}, 
     {0, 0, 0, 0, "Debug is optional." },
     {"debug",    'd', 0, OPTION_ARG_OPTIONAL, "Optional debug flag"}, 
+    {0, 0, 0, 0, "Buffer tuning is optional." },
+    {"alloc",    'a', "MODE", 0,                  "Buffer allocator: default or huge (huge pages, pre-faulted)"}, 
+    {"slots",    's', "MODE", 0,                  "Buffer slot layout: packed or padded (one slot per cache line)"}, 
+    {0, 0, 0, 0, "Priority lanes are optional. Setting either length gives each kind of producer its own lane." },
+    {"good-length",   'g', "NUM", 0,             "The length of the functional producers' lane (defaults to -l)"}, 
+    {"faulty-length", 'b', "NUM", 0,             "The length of the faulty producers' lane (defaults to -l)"}, 
+    {"weight",        'w', "NUM", 0,             "Consume one faulty item after every NUM functional items (0, the default, for strict priority)"}, 
     {0}
 };
 
@@ -63,6 +71,28 @@ static error_t parse_opt (int key, char *arg, struct argp_state *state) {
         case 'd':
             arguments->debug = true;
             break;
+        case 'a':
+            if(strcmp(arg, "default") == 0) arguments->alloc = ALLOC_DEFAULT;
+            else if(strcmp(arg, "huge") == 0) arguments->alloc = ALLOC_HUGE;
+            else argp_error(state, "invalid allocator '%s'", arg);
+            break;
+        case 's':
+            if(strcmp(arg, "packed") == 0) arguments->layout = LAYOUT_PACKED;
+            else if(strcmp(arg, "padded") == 0) arguments->layout = LAYOUT_PADDED;
+            else argp_error(state, "invalid slot layout '%s'", arg);
+            break;
+        case 'g':
+            arguments->lane_length[LANE_FNCTNL] = atoi(arg);
+            if(arguments->lane_length[LANE_FNCTNL] <= 0) argp_error(state, "invalid lane length '%s'", arg);
+            break;
+        case 'b':
+            arguments->lane_length[LANE_FAULTY] = atoi(arg);
+            if(arguments->lane_length[LANE_FAULTY] <= 0) argp_error(state, "invalid lane length '%s'", arg);
+            break;
+        case 'w':
+            arguments->weight = atoi(arg);
+            if(arguments->weight < 0) argp_error(state, "invalid weight '%s'", arg);
+            break;
     default:
         return ARGP_ERR_UNKNOWN;
     }
@@ -80,24 +110,55 @@ static struct argp argp = { options, parse_opt, args_doc, doc };
  * @return arguments
  */
 struct arguments get_arguments(int argc, char **argv) {
-    if(!(argc == 2 || argc == 11 || argc == 12)) {
+    if(!(argc == 2 || argc >= 11)) {
         fprintf(stderr, "Usage: pc [OPTION...]\n");
         printf("\nSee `./pc --help' for more details.\n");
         exit(1);
     }
 
     struct arguments arguments;
+    // -1 marks a mandatory option that was never given.
+    arguments.items = -1;
+    arguments.length = -1;
+    arguments.producer = -1;
+    arguments.faulty = -1;
+    arguments.consumer = -1;
     arguments.debug = false;
+    arguments.alloc = ALLOC_DEFAULT;
+    arguments.layout = LAYOUT_PACKED;
+    arguments.lane_length[LANE_FNCTNL] = 0;
+    arguments.lane_length[LANE_FAULTY] = 0;
+    arguments.weight = 0;
 
     argp_parse(&argp, argc, argv, 0, 0, &arguments);
 
+    // The optional arguments can make up the count, so check that every mandatory one was given
+    // and that there is a buffer, something to produce into it, and something to consume from it.
+    if(arguments.items < 0 || arguments.length <= 0 || arguments.producer < 0 || arguments.faulty < 0 || arguments.consumer <= 0
+       || arguments.producer + arguments.faulty == 0) {
+        fprintf(stderr, "Usage: pc [OPTION...]\n");
+        printf("\nSee `./pc --help' for more details.\n");
+        exit(1);
+    }
+
+    // In lane mode, a lane without its own length gets the length of the buffer.
+    if(arguments.lane_length[LANE_FNCTNL] || arguments.lane_length[LANE_FAULTY]) {
+        if(!arguments.lane_length[LANE_FNCTNL]) arguments.lane_length[LANE_FNCTNL] = arguments.length;
+        if(!arguments.lane_length[LANE_FAULTY]) arguments.lane_length[LANE_FAULTY] = arguments.length;
+    }
+
     if(verbose) {
         printf("-n: %d\n", arguments.items);
         printf("-l: %d\n", arguments.length);
         printf("-p: %d\n", arguments.producer);
         printf("-f: %d\n", arguments.faulty);
         printf("-c: %d\n", arguments.consumer);
-        printf("-d: %s\n\n", arguments.debug ? "true" : "false");
+        printf("-d: %s\n", arguments.debug ? "true" : "false");
+        printf("-a: %s\n", arguments.alloc == ALLOC_HUGE ? "huge" : "default");
+        printf("-s: %s\n", arguments.layout == LAYOUT_PADDED ? "padded" : "packed");
+        printf("-g: %d\n", arguments.lane_length[LANE_FNCTNL]);
+        printf("-b: %d\n", arguments.lane_length[LANE_FAULTY]);
+        printf("-w: %d\n\n", arguments.weight);
     }
 
     return arguments;
@@ -38,6 +38,20 @@ void initialize_stats(int items, int length, int producers, int faulties, int co
     consumed_thread = calloc(sizeof(int), consumers);
 }
 
+/**
+ * @brief Helper function to initialize the statistics of each lane.
+ * 
+ * @param lanes the number of lanes, 1 when all producers share the buffer
+ * @param lengths the length of each lane
+ */
+void initialize_lanes(int lanes, int *lengths) {
+    num_lanes = lanes;
+
+    for(int i = 0; i < lanes; i++) {
+        lane_stats[i] = (struct lane_stats) { .length = lengths[i] };
+    }
+}
+
 /**
  * @brief Helper function to print the program's final statistics.
  * 
@@ -46,13 +60,20 @@ void display_stats() {
     printf("\nPRODUCER / CONSUMER SIMULATION COMPLETE\n");
     printf("=======================================\n");
     printf("Number of Items Per Producer Thread: %d\n", num_items_per_producer);
-    printf("Size of Buffer: %d\n", buffer_size);
+    if(num_lanes == 1) {
+        printf("Size of Buffer: %d\n", buffer_size);
+    } else {
+        printf("Size of Functional Lane: %d\n", lane_stats[LANE_FNCTNL].length);
+        printf("Size of Faulty Lane: %d\n", lane_stats[LANE_FAULTY].length);
+    }
     printf("Number of Producer Threads: %d\n", num_producers);
     printf("Number of Faulty Producer Threads: %d\n", num_faulty);
     printf("Number of Consumer Threads: %d\n", num_consumer);
 
-    printf("\nNumber of Times Buffer Became Full %d\n", num_full);
-    printf("Number of Times Buffer Became Empty %d\n", num_empty);
+    // With lanes, each lane filling up or running empty counts.
+    const char *buffer_name = num_lanes == 1 ? "Buffer" : "a Lane";
+    printf("\nNumber of Times %s Became Full %d\n", buffer_name, num_full);
+    printf("Number of Times %s Became Empty %d\n", buffer_name, num_empty);
 
     printf("\nNumber of Non-primes Detected %d\n", num_nonprimes);
     printf("Total Number of Items Consumed: %d\n", total_consumed);
@@ -61,20 +82,58 @@ void display_stats() {
     for(i = 0; i < num_consumer; i++) {
         printf("  Thread %d: %d\n", i + 1, consumed_thread[i]); // Will need an array here, likely.
     }
-    timersub(&time_end, &time_start, &time_elapsed);
-    printf("\nTotal Simulation Time: %ld.%06ld seconds\n", (long int) time_elapsed.tv_sec, (long int) time_elapsed.tv_usec);
+
+    const char *lane_names[LANES] = { num_lanes == 1 ? "Shared" : "Functional", "Faulty" };
+    printf("\nLane Statistics (latency in ms, occupancy in items)\n");
+    for(i = 0; i < num_lanes; i++) {
+        struct lane_stats *stats = &lane_stats[i];
+        long items = stats->items ? stats->items : 1;
+
+        printf("  %-10s length %6d  items %8ld  latency avg %9.3f max %9.3f  occupancy avg %9.1f max %6d\n",
+               lane_names[i], stats->length, stats->items, stats->latency_total / items * 1e3, stats->latency_max * 1e3,
+               (double) stats->occupancy_total / items, stats->occupancy_max);
+    }
+
+    printf("\n");
+    print_elapsed("Startup Time", &time_start, &time_released);
+    print_elapsed("Steady-State Time", &time_released, &time_finished);
+    print_elapsed("Teardown Time", &time_finished, &time_end);
+    print_elapsed("Total Simulation Time", &time_start, &time_end);
+}
+
+/**
+ * @brief Helper function to print the time between two readings of CLOCK_MONOTONIC.
+ * 
+ * @param label what the time measures
+ * @param from the earlier reading
+ * @param to the later reading
+ */
+void print_elapsed(const char *label, struct timespec *from, struct timespec *to) {
+    long int sec = to->tv_sec - from->tv_sec;
+    long int nsec = to->tv_nsec - from->tv_nsec;
+
+    if(nsec < 0) {
+        sec--;
+        nsec += 1000000000;
+    }
+
+    printf("%s: %ld.%06ld seconds\n", label, sec, nsec / 1000);
 }
 
 /**
  * @brief Helper function to print out an update after each production or consumption.
  * 
  * @param type the type of pthread
- * @param number the number either generated or consumed
+ * @param item the item either generated or consumed
  * @param tid the TID of the calling pthread
+ * @param lane the lane the item went into or came out of
  * @param pthread_arg the thread's argument
  */
-void print_update(int type, int number, int tid, struct pthread_arg *pthread_arg) {
-    int buffer_items, index;
+void print_update(int type, struct item item, int tid, int lane, struct pthread_arg *pthread_arg) {
+    int buffer_items, index, number = item.number;
+    struct bounded_queue *queue = &pthread_arg->lanes[lane];
+
+    update_lane_stats(type, item, lane, queue);
 
     // If the caller is of type functional producer,
     if(type == FNCTNL_PROD) {
@@ -83,10 +142,11 @@ void print_update(int type, int number, int tid, struct pthread_arg *pthread_arg
         if(pthread_arg->prog_arg->debug) printf("(PRODUCER %3d writes %3d/%d %4d): ", index + 1, functional_produced[index], num_items_per_producer, number);
 
         // print the current array,
-        buffer_items = print_array(pthread_arg->buffer, pthread_arg->prog_arg->length, pthread_arg->prog_arg->debug);
+        if(pthread_arg->prog_arg->debug && num_lanes > 1) printf("%s ", lane == LANE_FNCTNL ? "{GOOD}" : "{BAD} ");
+        buffer_items = print_array(queue, pthread_arg->prog_arg->debug);
 
-        // and determine if the buffer is full.
-        if(buffer_items == buffer_size) {
+        // and determine if the lane is full.
+        if(buffer_items == queue->capacity) {
             if(pthread_arg->prog_arg->debug)  printf("*BUFFER NOW FULL* ");
             num_full++;
         }
@@ -98,10 +158,11 @@ void print_update(int type, int number, int tid, struct pthread_arg *pthread_arg
         if(pthread_arg->prog_arg->debug) printf("(PR*D*C*R %3d writes %3d/%d %4d): ", index + 1, faulty_produced[index], num_items_per_producer, number);
 
         // print the current array,
-        buffer_items = print_array(pthread_arg->buffer, pthread_arg->prog_arg->length, pthread_arg->prog_arg->debug);
+        if(pthread_arg->prog_arg->debug && num_lanes > 1) printf("%s ", lane == LANE_FNCTNL ? "{GOOD}" : "{BAD} ");
+        buffer_items = print_array(queue, pthread_arg->prog_arg->debug);
 
-        // and determine if the buffer is full.
-        if(buffer_items == buffer_size) {
+        // and determine if the lane is full.
+        if(buffer_items == queue->capacity) {
             if(pthread_arg->prog_arg->debug) printf("*BUFFER NOW FULL* ");
             num_full++;
         }
@@ -113,7 +174,8 @@ void print_update(int type, int number, int tid, struct pthread_arg *pthread_arg
         if(pthread_arg->prog_arg->debug) printf("(CONSUMER %3d reads %4d %9d): ", index + 1, consumed_thread[index], number);
 
         // print the current array,
-        buffer_items = print_array(pthread_arg->buffer, pthread_arg->prog_arg->length, pthread_arg->prog_arg->debug);
+        if(pthread_arg->prog_arg->debug && num_lanes > 1) printf("%s ", lane == LANE_FNCTNL ? "{GOOD}" : "{BAD} ");
+        buffer_items = print_array(queue, pthread_arg->prog_arg->debug);
 
         // and determine if the number is not prime,
         if(!(is_prime(number))) {
@@ -121,7 +183,7 @@ void print_update(int type, int number, int tid, struct pthread_arg *pthread_arg
             num_nonprimes++;
         }
         
-        // and if the buffer is empty.
+        // and if the lane is empty.
         if(buffer_items == 0) {
             if(pthread_arg->prog_arg->debug) printf("*BUFFER NOW EMPTY* ");
             num_empty++;
@@ -131,6 +193,34 @@ void print_update(int type, int number, int tid, struct pthread_arg *pthread_arg
     if(pthread_arg->prog_arg->debug) printf("\n");
 }
 
+/**
+ * @brief Helper function to update the statistics of a lane after each production or consumption.
+ * 
+ * @param type the type of pthread
+ * @param item the item either generated or consumed
+ * @param lane the lane
+ * @param queue the lane's queue
+ */
+void update_lane_stats(int type, struct item item, int lane, struct bounded_queue *queue) {
+    struct lane_stats *stats = &lane_stats[lane];
+
+    // Producers sample how full the lane is,
+    if(type != CONSUMER) {
+        stats->occupancy_total += queue->count;
+        if(queue->count > stats->occupancy_max) stats->occupancy_max = queue->count;
+
+    // and consumers measure how long the item waited.
+    } else {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        double latency = (now.tv_sec - item.produced.tv_sec) + (now.tv_nsec - item.produced.tv_nsec) / 1e9;
+        stats->latency_total += latency;
+        if(latency > stats->latency_max) stats->latency_max = latency;
+        stats->items++;
+    }
+}
+
 /**
  * @brief Helper function to update arrays, tracking the tid-to-index and tid-to-actions.
  * 
@@ -170,28 +260,21 @@ int update_arrays(int type, int tid) {
 /**
  * @brief Helper function to print the nnumber of items in the buffer and the buffer itself.
  * 
- * @param array the array
- * @param size the size fo the array
+ * @param queue the buffer, which must be locked by the caller
  * @param debug flag to indicate whether to print the array
- * @return int the count of non-zero entries
+ * @return int the count of items in the buffer
  */
-int print_array(int *array, int size, int debug) {
-    int count = 0;
-    for(int i = 0; i < size; i++) {
-        if(array[i] != 0) {
-            count++;
-        }
-    }
+int print_array(struct bounded_queue *queue, int debug) {
+    int count = queue->count;
     
     if(debug) {
-        // Print the number of non-zero items in the array.
+        // Print the number of items in the buffer.
         printf("(%d): ", count);
 
+        // Print the items, oldest first.
         printf("[ ");
-        for(int i = 0; i < size; i++) {
-            if(array[i] != 0) {
-                printf("%6d%2s", array[i], "");
-            }
+        for(int i = 0; i < count; i++) {
+            printf("%6d%2s", queue_at(queue, i).number, "");
         }
         printf("] ");
     }
@@ -17,7 +17,10 @@
 #include "definitions.h"
 
 void initialize_stats(int items, int length, int producers, int faulties, int consumers);
+void initialize_lanes(int lanes, int *lengths);
 void display_stats();
-void print_update(int type, int number, int tid, struct pthread_arg *pthread_arg);
+void print_elapsed(const char *label, struct timespec *from, struct timespec *to);
+void print_update(int type, struct item item, int tid, int lane, struct pthread_arg *pthread_arg);
+void update_lane_stats(int type, struct item item, int lane, struct bounded_queue *queue);
 int update_arrays(int type, int tid);
-int print_array(int *array, int size, int debug);
\ No newline at end of file
+int print_array(struct bounded_queue *queue, int debug);
\ No newline at end of file
@@ -21,6 +21,7 @@
 #include <sys/syscall.h>
 
 #include "input.h"
+#include "buffer.h"
 #include "threads.h"
 #include "output.h"
 
@@ -34,31 +35,52 @@ int main (int argc, char **argv) {
 
     // Create the argument that gets passed to all pthreads.
     struct pthread_arg thread_arg;
+    int lane, lengths[LANES];
+    void *buffers[LANES];
+    size_t buffer_bytes[LANES];
 
-    sem_init(&thread_arg.mutex, 0, 1);
-    sem_init(&thread_arg.empty, 0, arguments.length);
-    sem_init(&thread_arg.full, 0, 0);
-
-    thread_arg.in = 0;
-    thread_arg.out = 0;
     thread_arg.prog_arg = &arguments;
-    thread_arg.buffer = calloc(sizeof(int), arguments.length);
+    sem_init(&thread_arg.ready, 0, 0);
+    sem_init(&thread_arg.report, 0, 1);
+    thread_arg.streak = 0;
+
+    // Without lanes, the only lane is the whole buffer.
+    int lanes = arguments.lane_length[LANE_FNCTNL] ? LANES : 1;
+    lengths[LANE_FNCTNL] = lanes == 1 ? arguments.length : arguments.lane_length[LANE_FNCTNL];
+    lengths[LANE_FAULTY] = arguments.lane_length[LANE_FAULTY];
 
     // Initialize buffer and simulation statistics.
     initialize_stats(arguments.items, arguments.length, arguments.producer, arguments.faulty, arguments.consumer);
+    initialize_lanes(lanes, lengths);
+
+    size_t stride = slot_stride(arguments.layout, sizeof(struct item));
+    for(lane = 0; lane < num_lanes; lane++) {
+        buffer_bytes[lane] = stride * lengths[lane];
+        buffers[lane] = allocate_buffer(buffer_bytes[lane], arguments.alloc);
+        queue_init(&thread_arg.lanes[lane], buffers[lane], lengths[lane], stride);
+    }
 
     // Start timer.
-    gettimeofday(&time_start, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &time_start);
+
+    // Create the threads. They all wait at the start barrier, along with main, so creating
+    // them stays out of the steady state.
+    int threads = arguments.producer + arguments.faulty + arguments.consumer;
+    sem_init(&thread_arg.arrived, 0, 0);
+    pthread_barrier_init(&thread_arg.start, NULL, threads + 1);
 
-    // Create the threads.
     producer_arr = calloc(sizeof(pthread_t), arguments.producer);
     faulty_arr = calloc(sizeof(pthread_t), arguments.faulty);
     consumer_arr = calloc(sizeof(pthread_t), arguments.consumer);
+    allocate_stacks(threads);
 
     printf("Starting Threads...\n\n");
-    create_pthread(producer_arr, arguments.producer, FNCTNL_PROD, &thread_arg);
-    create_pthread(faulty_arr, arguments.faulty, FAULTY_PROD, &thread_arg);
-    create_pthread(consumer_arr, arguments.consumer, CONSUMER, &thread_arg);
+    create_pthread(producer_arr, arguments.producer, FNCTNL_PROD, &thread_arg, 0);
+    create_pthread(faulty_arr, arguments.faulty, FAULTY_PROD, &thread_arg, arguments.producer);
+    create_pthread(consumer_arr, arguments.consumer, CONSUMER, &thread_arg, arguments.producer + arguments.faulty);
+
+    // Release all the threads at once.
+    release_pthreads(&thread_arg, threads);
 
     // Join the threads.
     join_pthreads(producer_arr, arguments.producer);
@@ -66,9 +88,17 @@ int main (int argc, char **argv) {
     join_pthreads(consumer_arr, arguments.consumer);
 
     // Get time after all threads have exited.
-    gettimeofday(&time_end, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &time_end);
 
     display_stats();
 
-    free_structures(thread_arg.buffer);
+    free_structures();
+    for(lane = 0; lane < num_lanes; lane++) {
+        queue_destroy(&thread_arg.lanes[lane]);
+        free_buffer(buffers[lane], buffer_bytes[lane], arguments.alloc);
+    }
+    sem_destroy(&thread_arg.ready);
+    sem_destroy(&thread_arg.report);
+    sem_destroy(&thread_arg.arrived);
+    pthread_barrier_destroy(&thread_arg.start);
 }
\ No newline at end of file
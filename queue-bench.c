@@ -0,0 +1,135 @@
+/**
+ * @file queue-bench.c
+ * @author Matthew Bolding; Griffin McPherson
+ * @brief Microbenchmark for the bounded queue in queue.h.
+ * @version 0.1
+ * @date 2022-04-13
+ * 
+ * @copyright Copyright (c) 2022
+ * 
+ * One producer passes a fixed number of items to one consumer, first one at a time and then
+ * in batches, and the time per item is reported. Build with -DQUEUE_CAPACITY=N to measure
+ * the variant whose capacity is fixed at compile time.
+ * 
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "queue.h"
+
+#define ITEMS 2000000
+#define BATCH 16
+
+struct bounded_queue queue;
+int batch_size;
+
+/**
+ * @brief Entrance function for the producer thread.
+ * 
+ * @param data not in use
+ * @return void* not in use
+ */
+static void *producer(void *data) {
+    int batch[BATCH];
+
+    for(int i = 0; i < ITEMS; i += batch_size) {
+        if(batch_size == 1) {
+            queue_push(&queue, i, NULL, NULL);
+        } else {
+            for(int j = 0; j < batch_size; j++) batch[j] = i + j;
+            queue_push_batch(&queue, batch, batch_size, NULL, NULL);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Entrance function for the consumer thread.
+ * 
+ * @param data where to store the sum of the items, so the work is not optimized away
+ * @return void* not in use
+ */
+static void *consumer(void *data) {
+    int batch[BATCH];
+    long sum = 0;
+
+    for(int i = 0; i < ITEMS; i += batch_size) {
+        if(batch_size == 1) {
+            sum += queue_pop(&queue, NULL, NULL);
+        } else {
+            queue_pop_batch(&queue, batch, batch_size, NULL, NULL);
+            for(int j = 0; j < batch_size; j++) sum += batch[j];
+        }
+    }
+
+    *(long *) data = sum;
+
+    return NULL;
+}
+
+/**
+ * @brief Helper function to time one run of the benchmark.
+ * 
+ * @param capacity the capacity of the queue
+ * @param batch the number of items per push and pop
+ */
+static void run(int capacity, int batch) {
+    pthread_t producer_thread, consumer_thread;
+    struct timespec start, end;
+    int *slots = calloc(capacity, sizeof(int));
+    long sum;
+
+    if(queue_init(&queue, slots, capacity, sizeof(int)) != 0) {
+        fprintf(stderr, "queue_init failed for capacity %d\n", capacity);
+        exit(1);
+    }
+    batch_size = batch;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_create(&consumer_thread, NULL, consumer, &sum);
+    pthread_create(&producer_thread, NULL, producer, NULL);
+    pthread_join(producer_thread, NULL);
+    pthread_join(consumer_thread, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("capacity %5d%s  batch %2d: %7.1f ns/item\n", capacity, queue.mask ? " (mask)" : "       ",
+           batch, elapsed * 1e9 / ITEMS);
+
+    queue_destroy(&queue);
+    free(slots);
+}
+
+/**
+ * @brief Runs the benchmark for each capacity given on the command line.
+ * 
+ */
+int main(int argc, char **argv) {
+    if(argc < 2) {
+        fprintf(stderr, "Usage: %s CAPACITY...\n", argv[0]);
+        return 1;
+    }
+
+#ifdef QUEUE_CAPACITY
+    printf("capacity fixed at compile time\n");
+#endif
+
+    for(int i = 1; i < argc; i++) {
+        int capacity = atoi(argv[i]);
+
+        // Batches may use at most half the queue.
+        if(capacity < 2 * BATCH - 1) {
+            fprintf(stderr, "capacity must be at least %d\n", 2 * BATCH - 1);
+            return 1;
+        }
+
+        run(capacity, 1);
+        run(capacity, BATCH);
+    }
+
+    return 0;
+}
@@ -0,0 +1,195 @@
+/**
+ * @file queue-stress.c
+ * @author Matthew Bolding; Griffin McPherson
+ * @brief Stress test for the bounded queue in queue.h.
+ * @version 0.1
+ * @date 2022-04-13
+ * 
+ * @copyright Copyright (c) 2022
+ * 
+ * Many producers push every number in a range exactly once, mixing blocking, non-blocking
+ * and batch pushes. Many consumers drain the queue the same way. The test fails if any
+ * number is lost or seen twice, or if the count ever leaves [0, capacity].
+ * 
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "queue.h"
+
+#define PRODUCERS 6
+#define CONSUMERS 5
+#define ITEMS     20000
+#define BATCH     4
+#define SENTINEL  -1
+
+struct bounded_queue queue;
+unsigned char *seen;
+int volatile failures, finished;
+
+/**
+ * @brief Queue hook that checks the count after every operation.
+ * 
+ * @param queue the queue
+ * @param item not in use
+ * @param context not in use
+ */
+static void check_count(struct bounded_queue *queue, int item, void *context) {
+    if(queue->count < 0 || queue->count > queue->capacity) {
+        __atomic_add_fetch(&failures, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief Entrance function for producer threads.
+ * 
+ * @param data the index of the producer
+ * @return void* not in use
+ */
+static void *producer(void *data) {
+    int base = (int) (long) data * ITEMS;
+    int batch[BATCH], pending = 0;
+
+    for(int i = 0; i < ITEMS; i++) {
+        int number = base + i;
+
+        if(i % 3 == 0) {
+            queue_push(&queue, number, check_count, NULL);
+        } else if(i % 3 == 1) {
+            while(!queue_try_push(&queue, number, check_count, NULL)) sched_yield();
+        } else {
+            batch[pending++] = number;
+            if(pending == BATCH) {
+                queue_push_batch(&queue, batch, pending, check_count, NULL);
+                pending = 0;
+            }
+        }
+    }
+
+    if(pending) queue_push_batch(&queue, batch, pending, check_count, NULL);
+
+    return NULL;
+}
+
+/**
+ * @brief Helper function to record a consumed number.
+ * 
+ * @param number the number
+ * @return true if the number is the sentinel
+ */
+static bool record(int number) {
+    if(number == SENTINEL) return true;
+
+    if(number < 0 || number >= PRODUCERS * ITEMS || __atomic_add_fetch(&seen[number], 1, __ATOMIC_RELAXED) != 1) {
+        __atomic_add_fetch(&failures, 1, __ATOMIC_RELAXED);
+    }
+
+    return false;
+}
+
+/**
+ * @brief Entrance function for consumer threads. Stops after the first sentinel.
+ * 
+ * @param data not in use
+ * @return void* not in use
+ */
+static void *consumer(void *data) {
+    int batch[BATCH], number;
+    bool done = false;
+
+    for(int i = 0; !done; i++) {
+        if(i % 3 == 0) {
+            done = record(queue_pop(&queue, check_count, NULL));
+        } else if(i % 3 == 1) {
+            while(!queue_try_pop(&queue, &number, check_count, NULL)) sched_yield();
+            done = record(number);
+        } else {
+            queue_pop_batch(&queue, batch, BATCH, check_count, NULL);
+            for(int j = 0; j < BATCH; j++) done |= record(batch[j]);
+        }
+    }
+
+    __atomic_add_fetch(&finished, 1, __ATOMIC_RELAXED);
+
+    return NULL;
+}
+
+/**
+ * @brief Helper function to run the test against a queue of the given capacity.
+ * 
+ * @param capacity the capacity
+ * @return int the number of failures
+ */
+static int run(int capacity) {
+    pthread_t producers[PRODUCERS], consumers[CONSUMERS];
+    int *slots = calloc(capacity, sizeof(int));
+    int i;
+
+    seen = calloc(PRODUCERS * ITEMS, 1);
+    failures = 0;
+    finished = 0;
+
+    if(queue_init(&queue, slots, capacity, sizeof(int)) != 0) {
+        fprintf(stderr, "queue_init failed for capacity %d\n", capacity);
+        return 1;
+    }
+
+    // A batch over the limit could wait forever, so it must be refused instead.
+    int *oversized = calloc(capacity, sizeof(int));
+    if(queue_push_batch(&queue, oversized, queue_batch_limit(&queue) + 1, check_count, NULL) != -1) failures++;
+    if(queue_pop_batch(&queue, oversized, queue_batch_limit(&queue) + 1, check_count, NULL) != -1) failures++;
+    free(oversized);
+
+    for(i = 0; i < CONSUMERS; i++) pthread_create(&consumers[i], NULL, consumer, NULL);
+    for(i = 0; i < PRODUCERS; i++) pthread_create(&producers[i], NULL, producer, (void *) (long) i);
+    for(i = 0; i < PRODUCERS; i++) pthread_join(producers[i], NULL);
+
+    // Keep feeding sentinels until every consumer has stopped, even one waiting on a whole batch.
+    while(__atomic_load_n(&finished, __ATOMIC_RELAXED) < CONSUMERS) {
+        if(!queue_try_push(&queue, SENTINEL, check_count, NULL)) sched_yield();
+    }
+    for(i = 0; i < CONSUMERS; i++) pthread_join(consumers[i], NULL);
+
+    for(i = 0; i < PRODUCERS * ITEMS; i++) {
+        if(seen[i] != 1) failures++;
+    }
+
+    printf("capacity %5d: %s (%d failures)\n", capacity, failures ? "FAIL" : "ok", failures);
+
+    queue_destroy(&queue);
+    free(slots);
+    free(seen);
+
+    return failures;
+}
+
+/**
+ * @brief Runs the test for each capacity given on the command line.
+ * 
+ */
+int main(int argc, char **argv) {
+    int i, failed = 0;
+
+    if(argc < 2) {
+        fprintf(stderr, "Usage: %s CAPACITY...\n", argv[0]);
+        return 1;
+    }
+
+    for(i = 1; i < argc; i++) {
+        int capacity = atoi(argv[i]);
+
+        // Batches may use at most half the queue.
+        if(capacity < 2 * BATCH - 1) {
+            fprintf(stderr, "capacity must be at least %d\n", 2 * BATCH - 1);
+            return 1;
+        }
+
+        failed += run(capacity) != 0;
+    }
+
+    return failed ? 1 : 0;
+}
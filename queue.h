@@ -0,0 +1,383 @@
+/**
+ * @file queue.h
+ * @author Matthew Bolding; Griffin McPherson
+ * @brief A bounded, blocking queue shared between threads.
+ * @version 0.1
+ * @date 2022-04-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * The queue is header only so that each file including it can pick its own element type
+ * and capacity. Define these before the first include to configure it:
+ *
+ *   QUEUE_ELEM_TYPE  the type of the elements (int if not defined)
+ *   QUEUE_CAPACITY   a capacity fixed at compile time (chosen at run time if not defined)
+ *
+ * The storage is handed to queue_init() by the caller, so it can come from any allocator
+ * and use any slot stride. When the capacity is a power of two, indices wrap with a mask
+ * instead of a modulo.
+ *
+ */
+
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#ifndef QUEUE_ELEM_TYPE
+#define QUEUE_ELEM_TYPE int
+#endif
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+#if defined(QUEUE_CAPACITY) && (QUEUE_CAPACITY) <= 0
+#error "QUEUE_CAPACITY must be positive"
+#endif
+
+typedef QUEUE_ELEM_TYPE queue_elem_t;
+
+struct bounded_queue {
+    // Set by queue_init() and only read afterwards, so nothing ever invalidates this line.
+    char *slots __attribute__((aligned(CACHE_LINE_SIZE)));
+    size_t stride;
+    int capacity;
+    int mask;
+    // Every operation takes the lock and updates the count, so they share one line.
+    pthread_mutex_t lock __attribute__((aligned(CACHE_LINE_SIZE)));
+    int count;
+    int room_waiters;
+    int items_waiters;
+    // Single pushes and pops wait for one slot or element.
+    pthread_cond_t not_full __attribute__((aligned(CACHE_LINE_SIZE)));
+    pthread_cond_t not_empty;
+    // Batches wait for several at once on their own conditions, so a wakeup meant for a
+    // single push or pop is never spent on a batch that cannot use it.
+    pthread_cond_t room;
+    pthread_cond_t items;
+    // Producers write in and consumers write out, so they live on separate cache lines.
+    int in __attribute__((aligned(CACHE_LINE_SIZE)));
+    int out __attribute__((aligned(CACHE_LINE_SIZE)));
+};
+
+// Called with the queue still locked, right after an element is pushed or popped.
+typedef void (*queue_hook_t)(struct bounded_queue *queue, queue_elem_t item, void *context);
+
+/**
+ * @brief Helper function to advance an index by one slot, wrapping around at the capacity.
+ *
+ * @param queue the queue
+ * @param index the index
+ * @return int the next index
+ */
+static inline int queue_next(struct bounded_queue *queue, int index) {
+#if defined(QUEUE_CAPACITY) && ((QUEUE_CAPACITY) & ((QUEUE_CAPACITY) - 1)) == 0
+    return (index + 1) & ((QUEUE_CAPACITY) - 1);
+#elif defined(QUEUE_CAPACITY)
+    return (index + 1) % (QUEUE_CAPACITY);
+#else
+    if(queue->mask) return (index + 1) & queue->mask;
+    return (index + 1) % queue->capacity;
+#endif
+}
+
+/**
+ * @brief Helper function to get the slot at an index.
+ *
+ * @param queue the queue
+ * @param index the index
+ * @return queue_elem_t* the slot
+ */
+static inline queue_elem_t *queue_slot(struct bounded_queue *queue, int index) {
+    return (queue_elem_t *) (queue->slots + (size_t) index * queue->stride);
+}
+
+/**
+ * @brief Initializes an empty queue on top of caller provided storage.
+ *
+ * @param queue the queue
+ * @param slots the storage, at least capacity * stride bytes long
+ * @param capacity the number of slots
+ * @param stride the distance between consecutive slots in bytes, at least sizeof(queue_elem_t)
+ * @return int 0 on success, -1 if the arguments are invalid
+ */
+static inline int queue_init(struct bounded_queue *queue, void *slots, int capacity, size_t stride) {
+    if(capacity <= 0 || stride < sizeof(queue_elem_t)) return -1;
+#ifdef QUEUE_CAPACITY
+    if(capacity != (QUEUE_CAPACITY)) return -1;
+#endif
+
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->not_full, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->room, NULL);
+    pthread_cond_init(&queue->items, NULL);
+    queue->room_waiters = 0;
+    queue->items_waiters = 0;
+
+    queue->slots = slots;
+    queue->stride = stride;
+    queue->capacity = capacity;
+    queue->mask = (capacity > 1 && (capacity & (capacity - 1)) == 0) ? capacity - 1 : 0;
+    queue->count = 0;
+    queue->in = 0;
+    queue->out = 0;
+
+    return 0;
+}
+
+/**
+ * @brief Releases the lock and conditions of a queue. The storage belongs to the caller.
+ *
+ * @param queue the queue
+ */
+static inline void queue_destroy(struct bounded_queue *queue) {
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->not_full);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_cond_destroy(&queue->room);
+    pthread_cond_destroy(&queue->items);
+}
+
+/**
+ * @brief Helper function to get the element a number of positions behind the head.
+ * Only meaningful while the queue is locked, e.g., from within a hook.
+ *
+ * @param queue the queue
+ * @param position the position, counting from the oldest element
+ * @return queue_elem_t the element
+ */
+static inline queue_elem_t queue_at(struct bounded_queue *queue, int position) {
+    int index = queue->out + position;
+    if(index >= queue->capacity) index -= queue->capacity;
+    return *queue_slot(queue, index);
+}
+
+/**
+ * @brief Helper function to release the lock of a queue, also when a waiting thread is cancelled.
+ *
+ * @param queue the queue
+ */
+static inline void queue_unlock(void *queue) {
+    pthread_mutex_unlock(&((struct bounded_queue *) queue)->lock);
+}
+
+/**
+ * @brief Helper function to store an element. The caller holds the lock and has checked for room.
+ *
+ * @param queue the queue
+ * @param item the element
+ * @param hook optional function to call after storing
+ * @param context argument passed to the hook
+ */
+static inline void queue_store(struct bounded_queue *queue, queue_elem_t item, queue_hook_t hook, void *context) {
+    *queue_slot(queue, queue->in) = item;
+    queue->in = queue_next(queue, queue->in);
+    queue->count++;
+
+    if(hook) hook(queue, item, context);
+}
+
+/**
+ * @brief Helper function to remove an element. The caller holds the lock and has checked for one.
+ *
+ * @param queue the queue
+ * @param hook optional function to call after removing
+ * @param context argument passed to the hook
+ * @return queue_elem_t the element
+ */
+static inline queue_elem_t queue_load(struct bounded_queue *queue, queue_hook_t hook, void *context) {
+    queue_elem_t item = *queue_slot(queue, queue->out);
+    queue->out = queue_next(queue, queue->out);
+    queue->count--;
+
+    if(hook) hook(queue, item, context);
+
+    return item;
+}
+
+/**
+ * @brief Helper function to wake the poppers after n elements were stored.
+ *
+ * @param queue the queue
+ * @param n the number of elements
+ */
+static inline void queue_stored(struct bounded_queue *queue, int n) {
+    if(n == 1) pthread_cond_signal(&queue->not_empty);
+    else pthread_cond_broadcast(&queue->not_empty);
+
+    if(queue->items_waiters) pthread_cond_broadcast(&queue->items);
+}
+
+/**
+ * @brief Helper function to wake the pushers after n elements were removed.
+ *
+ * @param queue the queue
+ * @param n the number of elements
+ */
+static inline void queue_loaded(struct bounded_queue *queue, int n) {
+    if(n == 1) pthread_cond_signal(&queue->not_full);
+    else pthread_cond_broadcast(&queue->not_full);
+
+    if(queue->room_waiters) pthread_cond_broadcast(&queue->room);
+}
+
+/**
+ * @brief Pushes an element, waiting for a free slot if the queue is full.
+ *
+ * @param queue the queue
+ * @param item the element
+ * @param hook optional function to call while the queue is locked
+ * @param context argument passed to the hook
+ */
+static inline void queue_push(struct bounded_queue *queue, queue_elem_t item, queue_hook_t hook, void *context) {
+    pthread_mutex_lock(&queue->lock);
+    pthread_cleanup_push(queue_unlock, queue);
+
+    while(queue->count == queue->capacity) pthread_cond_wait(&queue->not_full, &queue->lock);
+
+    queue_store(queue, item, hook, context);
+    queue_stored(queue, 1);
+
+    pthread_cleanup_pop(1);
+}
+
+/**
+ * @brief Pops an element, waiting for one if the queue is empty.
+ *
+ * @param queue the queue
+ * @param hook optional function to call while the queue is locked
+ * @param context argument passed to the hook
+ * @return queue_elem_t the element
+ */
+static inline queue_elem_t queue_pop(struct bounded_queue *queue, queue_hook_t hook, void *context) {
+    queue_elem_t item;
+
+    pthread_mutex_lock(&queue->lock);
+    pthread_cleanup_push(queue_unlock, queue);
+
+    while(queue->count == 0) pthread_cond_wait(&queue->not_empty, &queue->lock);
+
+    item = queue_load(queue, hook, context);
+    queue_loaded(queue, 1);
+
+    pthread_cleanup_pop(1);
+
+    return item;
+}
+
+/**
+ * @brief Pushes an element only if a slot is free right now.
+ *
+ * @return true if the element was pushed
+ * @return false if the queue was full
+ */
+static inline bool queue_try_push(struct bounded_queue *queue, queue_elem_t item, queue_hook_t hook, void *context) {
+    pthread_mutex_lock(&queue->lock);
+
+    bool pushed = queue->count < queue->capacity;
+    if(pushed) {
+        queue_store(queue, item, hook, context);
+        queue_stored(queue, 1);
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+
+    return pushed;
+}
+
+/**
+ * @brief Pops an element only if one is available right now.
+ *
+ * @param item where to store the element
+ * @return true if an element was popped
+ * @return false if the queue was empty
+ */
+static inline bool queue_try_pop(struct bounded_queue *queue, queue_elem_t *item, queue_hook_t hook, void *context) {
+    pthread_mutex_lock(&queue->lock);
+
+    bool popped = queue->count > 0;
+    if(popped) {
+        *item = queue_load(queue, hook, context);
+        queue_loaded(queue, 1);
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+
+    return popped;
+}
+
+/**
+ * @brief Helper function to get the largest number of elements a batch may hold.
+ *
+ * @param queue the queue
+ * @return int half the capacity, rounded up
+ */
+static inline int queue_batch_limit(struct bounded_queue *queue) {
+    return (queue->capacity + 1) / 2;
+}
+
+/**
+ * @brief Pushes several elements at once, waiting until there is room for all of them.
+ *
+ * A batch push and a batch pop that together need more than capacity + 1 slots could
+ * both wait forever, so batches are limited to half the capacity, rounded up.
+ *
+ * @param items the elements
+ * @param n the number of elements, at most queue_batch_limit()
+ * @return int 0 on success, -1 if n is over the limit
+ */
+static inline int queue_push_batch(struct bounded_queue *queue, const queue_elem_t *items, int n, queue_hook_t hook, void *context) {
+    int i;
+
+    if(n > queue_batch_limit(queue)) return -1;
+    if(n <= 0) return 0;
+
+    pthread_mutex_lock(&queue->lock);
+    pthread_cleanup_push(queue_unlock, queue);
+
+    queue->room_waiters++;
+    while(queue->capacity - queue->count < n) pthread_cond_wait(&queue->room, &queue->lock);
+    queue->room_waiters--;
+
+    for(i = 0; i < n; i++) queue_store(queue, items[i], hook, context);
+    queue_stored(queue, n);
+
+    pthread_cleanup_pop(1);
+
+    return 0;
+}
+
+/**
+ * @brief Pops several elements at once, waiting until all of them are available.
+ * Batches are limited for the same reason as in queue_push_batch().
+ *
+ * @param items where to store the elements
+ * @param n the number of elements, at most queue_batch_limit()
+ * @return int 0 on success, -1 if n is over the limit
+ */
+static inline int queue_pop_batch(struct bounded_queue *queue, queue_elem_t *items, int n, queue_hook_t hook, void *context) {
+    int i;
+
+    if(n > queue_batch_limit(queue)) return -1;
+    if(n <= 0) return 0;
+
+    pthread_mutex_lock(&queue->lock);
+    pthread_cleanup_push(queue_unlock, queue);
+
+    queue->items_waiters++;
+    while(queue->count < n) pthread_cond_wait(&queue->items, &queue->lock);
+    queue->items_waiters--;
+
+    for(i = 0; i < n; i++) items[i] = queue_load(queue, hook, context);
+    queue_loaded(queue, n);
+
+    pthread_cleanup_pop(1);
+
+    return 0;
+}
+
+#endif
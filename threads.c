@@ -14,12 +14,118 @@
 #include <sys/syscall.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 #include <math.h>
+#include <sys/mman.h>
 
 #include "output.h"
 #include "threads.h"
 #include "definitions.h"
 
+// Every thread's stack, each below a guard page, in one mapping.
+static char *thread_stacks;
+static size_t stack_slot, stacks_bytes;
+
+// What a queue hook needs to know about the thread that called it.
+struct update_context {
+    int type;
+    int tid;
+    int lane;
+    struct pthread_arg *args;
+};
+
+/**
+ * @brief Queue hook that prints an update after each production.
+ * 
+ * @param queue the lane
+ * @param item the item just pushed
+ * @param context a struct update_context
+ */
+static void report_produced(struct bounded_queue *queue, struct item item, void *context) {
+    struct update_context *update = (struct update_context *) context;
+
+    sem_wait(&update->args->report);
+    print_update(update->type, item, update->tid, update->lane, update->args);
+    sem_post(&update->args->report);
+}
+
+/**
+ * @brief Queue hook that prints an update after each consumption and counts it.
+ * 
+ * @param queue the lane
+ * @param item the item just popped
+ * @param context a struct update_context
+ */
+static void report_consumed(struct bounded_queue *queue, struct item item, void *context) {
+    struct update_context *update = (struct update_context *) context;
+
+    sem_wait(&update->args->report);
+    print_update(CONSUMER, item, update->tid, update->lane, update->args);
+
+    // Keep track of the number of items consumed, and when the last one was.
+    total_consumed++;
+    if(total_consumed == num_items_per_producer * (num_producers + num_faulty)) clock_gettime(CLOCK_MONOTONIC, &time_finished);
+
+    // Count the functional items all consumers took in a row, for the weighted lane choice.
+    if(update->lane == LANE_FAULTY) update->args->streak = 0;
+    else update->args->streak++;
+    sem_post(&update->args->report);
+}
+
+/**
+ * @brief Helper function to put a number in the caller's lane, printing an update.
+ * 
+ * @param context the caller's struct update_context
+ * @param number the number
+ */
+static void produce(struct update_context *context, int number) {
+    struct item item = { .number = number };
+
+    // Stamp the item so its latency can be measured once it is consumed.
+    clock_gettime(CLOCK_MONOTONIC, &item.produced);
+
+    queue_push(&context->args->lanes[context->lane], item, report_produced, context);
+    sem_post(&context->args->ready);
+}
+
+/**
+ * @brief Helper function to remove an item from the lanes, printing an update and counting it.
+ * 
+ * The functional lane is served first. With a weight, the faulty lane is served first
+ * instead once all consumers together took that many functional items in a row.
+ * 
+ * @param context the caller's struct update_context
+ */
+static void consume(struct update_context *context) {
+    struct pthread_arg *args = context->args;
+    int first = LANE_FNCTNL, second = LANE_FAULTY, weight = args->prog_arg->weight;
+    struct item item;
+
+    sem_wait(&args->ready);
+
+    if(num_lanes == 1) {
+        first = second = LANE_FNCTNL;
+    } else if(weight > 0) {
+        sem_wait(&args->report);
+        if(args->streak >= weight) {
+            first = LANE_FAULTY;
+            second = LANE_FNCTNL;
+        }
+        sem_post(&args->report);
+    }
+
+    // An item is waiting in one of the lanes, but another consumer may get to a lane
+    // between the two attempts, so keep trying until one succeeds.
+    for(;;) {
+        context->lane = first;
+        if(queue_try_pop(&args->lanes[first], &item, report_consumed, context)) break;
+
+        context->lane = second;
+        if(queue_try_pop(&args->lanes[second], &item, report_consumed, context)) break;
+    }
+}
+
 /**
  * @brief Helper function to generate a random number for a type of thread.
  * 
@@ -65,23 +171,17 @@ void *faulty_producer(void *data) {
 
     // Get the TID.
     int tid = syscall(SYS_gettid);
+    struct update_context context = { FAULTY_PROD, tid, num_lanes == 1 ? LANE_FNCTNL : LANE_FAULTY, args };
+
+    // Wait for every other thread to be created.
+    wait_for_start(args);
 
     // Generate an amount of random even numbers, as specified by the pthread arguments.
     for(i = 0; i < args->prog_arg->items; i++) {
         number = generate_random(FAULTY_PROD);
-        
-        sem_wait(&args->empty);
-        sem_wait(&args->mutex);
 
-        // Put the number in the buffer, and update in.
-        args->buffer[args->in] = number;
-        args->in = (args->in + 1) % args->prog_arg->length;
-
-        // Print an update.
-        print_update(FAULTY_PROD, number, tid, args);
-
-        sem_post(&args->mutex);
-        sem_post(&args->full);
+        // Put the number in the buffer, printing an update.
+        produce(&context, number);
     }
 
     // Exit, after all numbers have been generated.
@@ -100,6 +200,10 @@ void *functional_producer(void *data) {
 
     // Get the TID.
     int tid = syscall(SYS_gettid);
+    struct update_context context = { FNCTNL_PROD, tid, LANE_FNCTNL, args };
+
+    // Wait for every other thread to be created.
+    wait_for_start(args);
     
     // Generate an amount of primee numbers, as specified by the pthread arguments.
     for(i = 0; i < args->prog_arg->items; i++) {
@@ -108,18 +212,8 @@ void *functional_producer(void *data) {
             number = generate_random(FNCTNL_PROD);
         } while (!is_prime(number));
 
-        sem_wait(&args->empty);
-        sem_wait(&args->mutex);
-
-        // Put the number in the buffer, and update in.
-        args->buffer[args->in] = number;
-        args->in = (args->in + 1) % args->prog_arg->length;
-
-        // Print an update.
-        print_update(FNCTNL_PROD, number, tid, args);
-
-        sem_post(&args->mutex);
-        sem_post(&args->full);
+        // Put the number in the buffer, printing an update.
+        produce(&context, number);
     }
 
     // Exit, after all numbers have been generated.
@@ -133,35 +227,19 @@ void *functional_producer(void *data) {
  * @return void* not in use
  */
 void *consumer(void *data) {
-    int number;
-    
     struct pthread_arg *args = (struct pthread_arg *) data;
     int total_produced = args->prog_arg->items * (args->prog_arg->producer + args->prog_arg->faulty);
 
     // Get the TID
     int tid = syscall(SYS_gettid);
+    struct update_context context = { CONSUMER, tid, LANE_FNCTNL, args };
 
-    while(total_consumed < total_produced) {
-        sem_wait(&args->full);
-        sem_wait(&args->mutex);
+    // Wait for every other thread to be created.
+    wait_for_start(args);
 
-        if(total_consumed == total_produced) {
-            pthread_exit(0);
-        }
-
-        // Remove an item from the buffer, set that index to 0, and update out.
-        number = args->buffer[args->out];
-        args->buffer[args->out] = 0;
-        args->out = (args->out + 1) % args->prog_arg->length;
-        
-        // Print an update.
-        print_update(CONSUMER, number, tid, args);
-        
-        // Keep track of the number of items consumed.
-        total_consumed++;
-
-        sem_post(&args->mutex);
-        sem_post(&args->empty);
+    while(total_consumed < total_produced) {
+        // Remove an item from the buffer, printing an update and counting it.
+        consume(&context);
         
         // At this point, only the thread executing this statement will
         // not be in a waiting state from the semaphore. All the pthreads
@@ -197,6 +275,71 @@ bool is_prime(int n) {
     return true;
 }
 
+/**
+ * @brief Helper function for a pthread to check in and wait at the start barrier.
+ * 
+ * @param thread_arg the thread's argument
+ */
+void wait_for_start(struct pthread_arg *thread_arg) {
+    sem_post(&thread_arg->arrived);
+    pthread_barrier_wait(&thread_arg->start);
+}
+
+/**
+ * @brief Helper function for main to release all pthreads through the start barrier.
+ * 
+ * Main waits until every pthread has checked in and notes the time before it arrives at
+ * the barrier itself, so the time is not delayed by the pthreads it wakes up.
+ * 
+ * @param thread_arg the thread's argument
+ * @param count the number of pthreads
+ */
+void release_pthreads(struct pthread_arg *thread_arg, int count) {
+    int i;
+
+    for(i = 0; i < count; i++) {
+        sem_wait(&thread_arg->arrived);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &time_released);
+
+    // With nothing to consume, the steady state ends as soon as it starts.
+    time_finished = time_released;
+    pthread_barrier_wait(&thread_arg->start);
+}
+
+/**
+ * @brief Helper function to map the stacks of all pthreads at once, before any is created.
+ * 
+ * Each stack is THREAD_STACK_SIZE bytes with a guard page below it, so an overflow
+ * faults instead of running into the neighbouring stack.
+ * 
+ * @param count the number of pthreads
+ */
+void allocate_stacks(int count) {
+    size_t page = sysconf(_SC_PAGESIZE);
+    int i;
+
+    stack_slot = THREAD_STACK_SIZE + page;
+    stacks_bytes = stack_slot * count;
+    if(count == 0) return;
+
+    thread_stacks = mmap(NULL, stacks_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK | MAP_NORESERVE, -1, 0);
+    if(thread_stacks == MAP_FAILED) {
+        perror("mmap");
+        exit(1);
+    }
+
+    for(i = 0; i < count; i++) {
+        // Each guard page splits the mapping, so very many threads can run into vm.max_map_count.
+        if(mprotect(thread_stacks + i * stack_slot, page, PROT_NONE) != 0) {
+            perror("mprotect");
+            fprintf(stderr, "Could not guard the stack of thread %d; check vm.max_map_count.\n", i + 1);
+            exit(1);
+        }
+    }
+}
+
 /**
  * @brief Helper function to call pthread_create on all pthreads in a given pthread_t array.
  * 
@@ -204,19 +347,39 @@ bool is_prime(int n) {
  * @param size size of the array
  * @param type the type of pthread, i.e., CONSUMER, FNCTNL_PROD, or FAULTY_PROD
  * @param thread_arg the thread's argument
+ * @param first_stack the index of the stack for the first pthread in the array
  */
-void create_pthread(pthread_t *list, int size, int type, struct pthread_arg *thread_arg) {
+void create_pthread(pthread_t *list, int size, int type, struct pthread_arg *thread_arg, int first_stack) {
     int i;
     void *function;
+    pthread_attr_t attr;
+    size_t page = stack_slot - THREAD_STACK_SIZE;
 
     // The function depends on the type of thread.
     if(type == CONSUMER) function = consumer;
     else if(type == FNCTNL_PROD) function = functional_producer;
     else if(type == FAULTY_PROD) function = faulty_producer;
 
+    pthread_attr_init(&attr);
+
     for(i = 0; i < size; i++) {
-        pthread_create(&list[i], NULL, function, (void *) thread_arg);
+        // Use the preallocated stack, skipping over its guard page.
+        // Otherwise the pthread would quietly get a default stack instead.
+        int error = pthread_attr_setstack(&attr, thread_stacks + (first_stack + i) * stack_slot + page, THREAD_STACK_SIZE);
+        if(error != 0) {
+            fprintf(stderr, "pthread_attr_setstack: %s (thread %d)\n", strerror(error), first_stack + i + 1);
+            exit(1);
+        }
+
+        // Main would wait forever for a pthread that never started, so give up instead.
+        error = pthread_create(&list[i], &attr, function, (void *) thread_arg);
+        if(error != 0) {
+            fprintf(stderr, "pthread_create: %s (thread %d)\n", strerror(error), first_stack + i + 1);
+            exit(1);
+        }
     }
+
+    pthread_attr_destroy(&attr);
 }
 
 /**
@@ -236,11 +399,10 @@ void join_pthreads(pthread_t *list, int size) {
 /**
  * @brief Helper function to free all data structures allocated with calloc().
  * 
- * @param array the buffer array
  */
-void free_structures(int *array) {
+void free_structures() {
     free(producer_arr); free(faulty_arr); free(consumer_arr);
     free((int*) tid_functional); free((int*) tid_faulty); free((int*) tid_consumer);
     free((int*) functional_produced); free((int*) faulty_produced); free((int*) consumed_thread);
-    free(array);
+    if(thread_stacks) munmap(thread_stacks, stacks_bytes);
 }
\ No newline at end of file
@@ -15,7 +15,10 @@
 
 int generate_random(int type);
 
-void create_pthread(pthread_t *list, int size, int type, struct pthread_arg *pthread_arg);
+void allocate_stacks(int count);
+void wait_for_start(struct pthread_arg *pthread_arg);
+void release_pthreads(struct pthread_arg *pthread_arg, int count);
+void create_pthread(pthread_t *list, int size, int type, struct pthread_arg *pthread_arg, int first_stack);
 void join_pthreads(pthread_t *list, int size);
 
 void *faulty_producer(void *data);
@@ -23,4 +26,4 @@ void *functional_producer(void *data);
 void *consumer(void *data);
 
 bool is_prime(int n);
-void free_structures(int *array);
\ No newline at end of file
+void free_structures();
\ No newline at end of file